@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "slab.h"
+#include "epoch.h"
+
+/* Objects retired during epoch e can be freed once the global epoch has
+   reached e + 2 : every thread reading during epoch e has exited by then.
+   Each thread hence keeps its retired objects in EPOCH_COUNT bags, one
+   per epoch modulo EPOCH_COUNT.
+*/
+#define EPOCH_COUNT 3
+
+#define INITIAL_RETIRED_BAG_SIZE 64
+
+struct Retired_obj{
+  struct Objs_cache *cache;
+  void *obj;
+};
+
+struct Retired_bag{
+  unsigned long epoch; //epoch during which the objects were retired
+  unsigned int count, size;
+  struct Retired_obj *objs;
+};
+
+struct Epoch_thread{
+  atomic_ulong local_epoch;
+  atomic_int active;
+  atomic_int in_use; //0 once the thread has exited, with no retired objects left
+
+  unsigned int nesting;
+
+  struct Retired_bag bags[EPOCH_COUNT];
+
+  struct Epoch_thread *next;
+};
+
+/*******************************************************
+                        Private data
+*******************************************************/
+
+static atomic_ulong global_epoch = 0;
+
+//records of all the threads which have used the epochs, never freed
+static _Atomic(struct Epoch_thread *) threads = NULL;
+
+static _Thread_local struct Epoch_thread *this_thread = NULL;
+
+//releases the record of a thread exiting without calling epoch_thread_exit(),
+//NB: not run for the main thread returning from main() nor on exit()
+static pthread_key_t this_thread_key;
+static pthread_once_t this_thread_key_once = PTHREAD_ONCE_INIT;
+
+/********************************************************
+ *                       Private methods
+ *******************************************************/
+
+static void release_thread(void *record);
+
+static void create_this_thread_key(void)
+{
+  if (pthread_key_create(&this_thread_key, release_thread) != 0) {
+    printf("Error : failed to create a thread key in %s\n", __func__);
+    exit(-1);
+  }
+}
+
+static void set_this_thread(struct Epoch_thread *t)
+{
+  pthread_once(&this_thread_key_once, create_this_thread_key);
+  pthread_setspecific(this_thread_key, t);
+  this_thread = t;
+}
+
+/* Return the record of the calling thread, registering it on first use.
+ */
+static struct Epoch_thread * get_this_thread(void)
+{
+  if (this_thread != NULL)
+    return this_thread;
+
+  //we try to reuse the record of a thread which has exited
+  for (struct Epoch_thread *t = atomic_load(&threads); t != NULL; t = t->next) {
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&t->in_use, &expected, 1)) {
+      set_this_thread(t);
+      return t;
+    }
+  }
+
+  struct Epoch_thread *t = calloc(1, sizeof(struct Epoch_thread));
+
+  if (t == NULL) {
+    printf("Error : failed to register a thread in %s\n", __func__);
+    exit(-1);
+  }
+
+  atomic_init(&t->local_epoch, 0);
+  atomic_init(&t->active, 0);
+  atomic_init(&t->in_use, 1);
+
+  t->next = atomic_load(&threads);
+  while ( !atomic_compare_exchange_weak(&threads, &t->next, t))
+    ;
+
+  set_this_thread(t);
+  return t;
+}
+
+/* Free the objects of a bag, the lock of their cache is held while
+ * freeing each run of consecutive objects of the same cache.
+ */
+static void free_retired_bag(struct Retired_bag *bag)
+{
+  struct Objs_cache *locked_cache = NULL;
+
+  for (unsigned int i = 0; i < bag->count; i++) {
+    if (bag->objs[i].cache != locked_cache) {
+      if (locked_cache != NULL)
+	objs_cache_unlock(locked_cache);
+      locked_cache = bag->objs[i].cache;
+      objs_cache_lock(locked_cache);
+    }
+
+    objs_cache_free(bag->objs[i].cache, bag->objs[i].obj);
+  }
+
+  if (locked_cache != NULL)
+    objs_cache_unlock(locked_cache);
+
+  bag->count = 0;
+}
+
+/* Advance the global epoch if every active thread has observed it.
+ * Return the global epoch.
+ */
+static unsigned long try_advance_epoch(void)
+{
+  unsigned long epoch = atomic_load(&global_epoch);
+
+  for (struct Epoch_thread *t = atomic_load(&threads); t != NULL; t = t->next) {
+    if (atomic_load(&t->active) && atomic_load(&t->local_epoch) != epoch)
+      return epoch;
+  }
+
+  //on failure another thread has advanced the epoch, epoch is updated
+  if (atomic_compare_exchange_strong(&global_epoch, &epoch, epoch + 1))
+    epoch++;
+
+  return epoch;
+}
+
+/* Free the objects retired by thread t which can no longer be accessed
+ * by readers, after trying to advance the global epoch.
+ * Return the number of freed objects.
+ */
+static unsigned int reclaim_thread(struct Epoch_thread *t)
+{
+  unsigned long epoch = try_advance_epoch();
+  unsigned int freed = 0;
+
+  for (unsigned int i = 0; i < EPOCH_COUNT; i++) {
+    struct Retired_bag *bag = &t->bags[i];
+
+    if (bag->count > 0 && bag->epoch + 2 <= epoch) {
+      freed += bag->count;
+      free_retired_bag(bag);
+    }
+  }
+
+  return freed;
+}
+
+/* Return 1 if thread t has retired objects of cache (of any cache if
+ * cache is NULL) which are not freed yet, 0 otherwise.
+ */
+static int has_retired_objs(const struct Epoch_thread *t, const struct Objs_cache *cache)
+{
+  for (unsigned int i = 0; i < EPOCH_COUNT; i++) {
+    const struct Retired_bag *bag = &t->bags[i];
+
+    for (unsigned int j = 0; j < bag->count; j++) {
+      if (cache == NULL || bag->objs[j].cache == cache)
+	return 1;
+    }
+  }
+
+  return 0;
+}
+
+/* Wait until the objects of cache (of any cache if cache is NULL) retired
+ * by thread t are freed. The readers still in a critical section are
+ * waited for.
+ */
+static void drain_thread(struct Epoch_thread *t, const struct Objs_cache *cache)
+{
+  assert(t->nesting == 0);
+
+  while (has_retired_objs(t, cache)) {
+    reclaim_thread(t);
+    if (has_retired_objs(t, cache))
+      sched_yield();
+  }
+}
+
+/* Free all the objects retired by a thread which exits and let its record
+ * be reused by another thread.
+ */
+static void release_thread(void *record)
+{
+  struct Epoch_thread *t = record;
+
+  drain_thread(t, NULL);
+
+  for (unsigned int i = 0; i < EPOCH_COUNT; i++) {
+    free(t->bags[i].objs);
+    t->bags[i].objs = NULL;
+    t->bags[i].size = 0;
+  }
+
+  atomic_store(&t->in_use, 0);
+}
+
+/********************************************************
+ *                       Public methods
+ *******************************************************/
+
+/* Start a read-side critical section, objects retired from now on
+ * are not freed until the matching epoch_exit(). Can be nested.
+ */
+void epoch_enter(void)
+{
+  struct Epoch_thread *t = get_this_thread();
+
+  if (t->nesting++ == 0) {
+    atomic_store_explicit(&t->active, 1, memory_order_relaxed);
+    atomic_store_explicit(&t->local_epoch, atomic_load(&global_epoch), memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+  }
+}
+
+void epoch_exit(void)
+{
+  struct Epoch_thread *t = get_this_thread();
+
+  assert(t->nesting > 0);
+
+  if (--t->nesting == 0)
+    atomic_store_explicit(&t->active, 0, memory_order_release);
+}
+
+/* Retire an object of a cache which may still be used by readers, it is
+ * freed by a later call to epoch_reclaim(), epoch_reclaim_cache() or
+ * epoch_thread_exit() from the same thread once no reader can access it
+ * anymore. No object is freed here, so the lock of a cache may be held.
+ */
+void objs_cache_free_deferred(struct Objs_cache *cache, void *obj)
+{
+  if (cache == NULL) {
+    printf("Error : cache NULL as parameter for %s\n", __func__);
+    exit(-1);
+  }
+
+  if (obj == NULL)
+    return;
+
+  struct Epoch_thread *t = get_this_thread();
+  unsigned long epoch = atomic_load(&global_epoch);
+  struct Retired_bag *bag = &t->bags[epoch % EPOCH_COUNT];
+
+  if (bag->epoch != epoch) {
+    //the bag holds objects retired at least EPOCH_COUNT epochs ago, which
+    //can't be freed here : they are kept until the bag can be freed
+    bag->epoch = epoch;
+  }
+
+  if (bag->count == bag->size) {
+    unsigned int new_size = (bag->size ? bag->size * 2 : INITIAL_RETIRED_BAG_SIZE);
+    struct Retired_obj *new_objs = realloc(bag->objs, new_size * sizeof(struct Retired_obj));
+
+    if (new_objs == NULL) {
+      printf("Error : failed to retire an object in %s\n", __func__);
+      exit(-1);
+    }
+
+    bag->objs = new_objs;
+    bag->size = new_size;
+  }
+
+  bag->objs[bag->count].cache = cache;
+  bag->objs[bag->count].obj = obj;
+  bag->count++;
+}
+
+/* Try to advance the global epoch and free the objects retired by the
+ * calling thread which can no longer be accessed by readers. To be called
+ * regularly by the threads retiring objects, without holding the lock of
+ * any cache.
+ * Return the number of freed objects.
+ */
+unsigned int epoch_reclaim(void)
+{
+  return reclaim_thread(get_this_thread());
+}
+
+/* Wait, outside of any critical section, until all the objects of cache
+ * retired by the calling thread are freed. Every thread which has retired
+ * objects of a cache must call it (or have exited) before the cache
+ * is destroyed.
+ */
+void epoch_reclaim_cache(struct Objs_cache *cache)
+{
+  if (this_thread != NULL && cache != NULL)
+    drain_thread(this_thread, cache);
+}
+
+/* Called by a thread which has used the epochs before it exits, outside
+ * of any critical section, or automatically when the thread returns from
+ * its start routine or calls pthread_exit(). The main thread and the
+ * threads ending through exit() must call it themselves.
+ * Wait until all the objects the thread has retired are freed.
+ */
+void epoch_thread_exit(void)
+{
+  if (this_thread != NULL) {
+    pthread_setspecific(this_thread_key, NULL);
+    release_thread(this_thread);
+    this_thread = NULL;
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef USERLAND_SLAB_EPOCH_H
+#define USERLAND_SLAB_EPOCH_H
+
+#include "slab.h"
+
+/* Epoch based reclamation of objects allocated from caches.
+
+   Readers of a concurrent data structure bracket their accesses with
+   epoch_enter()/epoch_exit(). An object unlinked from the structure is
+   retired with objs_cache_free_deferred() and only given back to its cache
+   once every thread which was reading when it was retired has exited.
+
+   The retired objects are freed by the thread retiring them, under the
+   lock of their cache (see objs_cache_lock()) : several threads can retire
+   objects of the same cache, as long as they also take this lock around
+   their own allocations and frees from the cache.
+
+   objs_cache_free_deferred() never frees objects and can be called while
+   holding the lock of a cache. The retired objects are freed by
+   epoch_reclaim(), which the threads retiring objects must call regularly,
+   epoch_reclaim_cache() and epoch_thread_exit() : these functions take the
+   locks of the caches and must not be called while holding the lock of
+   any cache.
+
+   Before a cache is destroyed, every thread which has retired objects of
+   the cache must have called epoch_reclaim_cache() or have exited.
+
+   A thread ending by returning from its start routine or by calling
+   pthread_exit() frees its retired objects when it exits. The main thread,
+   or a thread ending through exit(), must call epoch_thread_exit() itself,
+   since the destructors of the thread keys are not run for it.
+*/
+
+void epoch_enter(void);
+void epoch_exit(void);
+
+void objs_cache_free_deferred(struct Objs_cache *cache, void *obj);
+
+unsigned int epoch_reclaim(void);
+void epoch_reclaim_cache(struct Objs_cache *cache);
+void epoch_thread_exit(void);
+
+#endif
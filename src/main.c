@@ -3,12 +3,256 @@
 #include <stdlib.h>
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "queue.h"
 #include "slab.h"
+#include "epoch.h"
 
 #define N 1000000
 
+#define DEFERRED_SLOTS 64
+#define DEFERRED_WRITERS 2
+#define DEFERRED_READERS 2
+#define DEFERRED_SWAPS_PER_WRITER 500000
+#define DEFERRED_RECLAIM_PERIOD 64
+
+/* Objects shared between writers, which replace them and retire the old ones
+   with objs_cache_free_deferred(), and readers, which check that an object
+   is not reused while they read it.
+*/
+struct Check_obj{
+  unsigned long id;
+  unsigned long not_id;
+};
+
+static struct Objs_cache deferred_cache;
+static _Atomic(struct Check_obj *) deferred_slots[DEFERRED_SLOTS];
+static atomic_ulong deferred_next_id;
+static atomic_int deferred_stop;
+static atomic_ulong deferred_reads, deferred_errors;
+
+static struct Check_obj * new_check_obj(void)
+{
+  objs_cache_lock(&deferred_cache);
+  struct Check_obj *obj = objs_cache_alloc(&deferred_cache);
+  objs_cache_unlock(&deferred_cache);
+
+  if (obj == NULL) {
+    printf("Failed to allocate an object from a cache !\n");
+    exit(-1);
+  }
+
+  obj->id = atomic_fetch_add(&deferred_next_id, 1);
+  obj->not_id = ~obj->id;
+  return obj;
+}
+
+static void * deferred_writer(void *arg)
+{
+  unsigned int seed = (unsigned int)(uintptr_t)arg;
+
+  for (int i = 0; i < DEFERRED_SWAPS_PER_WRITER; i++) {
+    seed = seed * 1103515245 + 12345;
+    struct Check_obj *old = atomic_exchange(&deferred_slots[seed % DEFERRED_SLOTS], new_check_obj());
+    objs_cache_free_deferred(&deferred_cache, old);
+
+    if (i % DEFERRED_RECLAIM_PERIOD == 0)
+      epoch_reclaim();
+  }
+
+  epoch_thread_exit();
+  return NULL;
+}
+
+static void * deferred_reader(void *arg)
+{
+  unsigned int seed = (unsigned int)(uintptr_t)arg;
+
+  while ( !atomic_load(&deferred_stop)) {
+    epoch_enter();
+    seed = seed * 1103515245 + 12345;
+    struct Check_obj *obj = atomic_load(&deferred_slots[seed % DEFERRED_SLOTS]);
+    unsigned long id = obj->id;
+    //we widen the window during which a reused object would be noticed
+    for (volatile int i = 0; i < 100; i++)
+      ;
+    unsigned long not_id = obj->not_id;
+    epoch_exit();
+
+    if (not_id != ~id)
+      atomic_fetch_add(&deferred_errors, 1);
+    atomic_fetch_add(&deferred_reads, 1);
+  }
+
+  epoch_thread_exit();
+  return NULL;
+}
+
+/* Check that objects retired concurrently by several writers are neither
+   reused while readers access them nor leaked.
+   Return 0 on success.
+*/
+static int check_deferred_frees(size_t obj_size)
+{
+  pthread_t writers[DEFERRED_WRITERS], readers[DEFERRED_READERS];
+
+  if (obj_size < sizeof(struct Check_obj))
+    obj_size = sizeof(struct Check_obj);
+
+  if ( !objs_cache_init(&deferred_cache, obj_size, NULL)) {
+    printf("Error : cache initialisation failed !\n");
+    exit(-1);
+  }
+
+  for (int i = 0; i < DEFERRED_SLOTS; i++)
+    deferred_slots[i] = new_check_obj();
+
+  for (int i = 0; i < DEFERRED_READERS; i++)
+    pthread_create(&readers[i], NULL, deferred_reader, (void*)(uintptr_t)(i + 1));
+  for (int i = 0; i < DEFERRED_WRITERS; i++)
+    pthread_create(&writers[i], NULL, deferred_writer, (void*)(uintptr_t)(i + 100));
+
+  for (int i = 0; i < DEFERRED_WRITERS; i++)
+    pthread_join(writers[i], NULL);
+  atomic_store(&deferred_stop, 1);
+  for (int i = 0; i < DEFERRED_READERS; i++)
+    pthread_join(readers[i], NULL);
+
+  printf("%lu reads, %lu reads of reused objects, %u objects still allocated (%d expected)\n",
+	 atomic_load(&deferred_reads),
+	 atomic_load(&deferred_errors),
+	 deferred_cache.used_objs_count,
+	 DEFERRED_SLOTS);
+
+  int failed = (atomic_load(&deferred_errors) != 0 || deferred_cache.used_objs_count != DEFERRED_SLOTS);
+
+  objs_cache_destroy(&deferred_cache);
+
+  return failed;
+}
+
+
+//number of slabs filled by the check of the handles
+#define HANDLES_SLABS 10
+
+/* Allocate count objects of cache through handles.
+   Return the number of handles not referencing their object.
+*/
+static unsigned int alloc_handles(struct Objs_cache *cache, obj_handle_t *handles, unsigned int count)
+{
+  unsigned int errors = 0;
+
+  for (unsigned int i = 0; i < count; i++) {
+    void *obj;
+    handles[i] = objs_cache_alloc_handle(cache, &obj);
+
+    if (handles[i] == OBJ_HANDLE_NULL) {
+      printf("Failed to allocate an object from a cache !\n");
+      exit(-1);
+    }
+
+    if (objs_cache_handle_to_ptr(cache, handles[i]) != obj)
+      errors++;
+  }
+
+  return errors;
+}
+
+/* Return the number of handles which are not detected as stale.
+*/
+static unsigned int count_valid_handles(const struct Objs_cache *cache,
+					const obj_handle_t *handles,
+					unsigned int count)
+{
+  unsigned int valid = 0;
+
+  for (unsigned int i = 0; i < count; i++) {
+    if (objs_cache_handle_to_ptr(cache, handles[i]) != NULL)
+      valid++;
+  }
+
+  return valid;
+}
+
+/* Check that handles to freed objects, to the objects of a reset cache and
+   to the objects of destroyed slabs whose ids have been reused are detected
+   as stale.
+   Return 0 on success.
+*/
+static int check_handles(size_t obj_size)
+{
+  struct Objs_cache cache;
+  unsigned int errors = 0, stale_errors;
+
+  if ( !objs_cache_init(&cache, obj_size, NULL)
+       || !objs_cache_enable_handles(&cache, MAX_HANDLE_GENERATION_BITS)) {
+    printf("Error : cache initialisation failed !\n");
+    exit(-1);
+  }
+
+  unsigned int count = HANDLES_SLABS * cache.objs_per_slab;
+  obj_handle_t *handles = malloc(count * sizeof(obj_handle_t));
+  obj_handle_t *old_handles = malloc(count * sizeof(obj_handle_t));
+
+  if (handles == NULL || old_handles == NULL) {
+    printf("Allocation failed\n");
+    exit(-1);
+  }
+
+  errors += alloc_handles(&cache, handles, count);
+
+  //freed objects, then reallocated : the same objects are reused
+  for (unsigned int i = 0; i < count; i += 2)
+    objs_cache_free_handle(&cache, handles[i]);
+
+  stale_errors = count_valid_handles(&cache, handles, count) - count / 2;
+
+  for (unsigned int i = 0; i < count; i += 2) {
+    void *obj;
+    old_handles[i / 2] = handles[i];
+    handles[i] = objs_cache_alloc_handle(&cache, &obj);
+    if (objs_cache_handle_to_ptr(&cache, handles[i]) != obj)
+      errors++;
+  }
+
+  stale_errors += count_valid_handles(&cache, old_handles, (count + 1) / 2);
+  printf("freed objects : %u handles not detected as stale\n", stale_errors);
+  errors += stale_errors;
+
+  //reset cache, the slabs beyond the ones kept by the freeing policy are destroyed
+  unsigned int slab_count = cache.slab_count;
+  unsigned int slab_table_len = cache.slab_table_len;
+
+  objs_cache_reset(&cache);
+
+  stale_errors = count_valid_handles(&cache, handles, count);
+  printf("reset cache : %u handles not detected as stale, %u slabs destroyed\n",
+	 stale_errors,
+	 slab_count - cache.slab_count);
+  errors += stale_errors + (cache.slab_count == slab_count);
+
+  //new slabs reuse the ids of the destroyed slabs
+  for (unsigned int i = 0; i < count; i++)
+    old_handles[i] = handles[i];
+
+  errors += alloc_handles(&cache, handles, count);
+
+  stale_errors = count_valid_handles(&cache, old_handles, count);
+  printf("reused slab ids : %u handles not detected as stale, %s\n",
+	 stale_errors,
+	 (cache.slab_table_len == slab_table_len) ? "ids reused" : "ids NOT reused");
+  errors += stale_errors + (cache.slab_table_len != slab_table_len);
+
+  printf("%u errors\n", errors);
+
+  free(handles);
+  free(old_handles);
+  objs_cache_destroy(&cache);
+
+  return (errors != 0);
+}
 
 int main(int argc, char **argv)
 {
@@ -17,6 +261,8 @@ int main(int argc, char **argv)
     <program> <alloc_type> <size>
     <alloc_type> = 1 - malloc based allocation
     <alloc_type> = 2 - slab based allocation
+    <alloc_type> = 3 - check of the deferred frees by concurrent threads
+    <alloc_type> = 4 - check of the detection of stale handles
     <size> = size in bytes of the objects to allocate
   */
   
@@ -26,6 +272,8 @@ int main(int argc, char **argv)
 	     "program <alloc_type> <size>\n"\
 	     "<alloc_type> = 1 - malloc based allocation\n"\
 	     "<alloc_type> = 2 - slab based allocation\n"\
+	     "<alloc_type> = 3 - check of the deferred frees by concurrent threads\n"\
+	     "<alloc_type> = 4 - check of the detection of stale handles\n"\
 	     "<size> = size in bytes of the objects to allocate\n");
       return 0;
     }
@@ -52,6 +300,34 @@ int main(int argc, char **argv)
     
     getchar();
   }
+  else if (argv[1][0] == '3'){
+    printf("Deferred frees of objects of size %lu by %d writers with %d readers\n", obj_size, DEFERRED_WRITERS, DEFERRED_READERS);
+
+    if ( !slab_allocator_init()){
+      printf("Error : slab allocator initialisation failed !\n");
+      exit(-1);
+    }
+
+    int failed = check_deferred_frees(obj_size);
+
+    slab_allocator_destroy();
+
+    return failed ? -1 : 0;
+  }
+  else if (argv[1][0] == '4'){
+    printf("Stale handles detection with objects of size %lu\n", obj_size);
+
+    if ( !slab_allocator_init()){
+      printf("Error : slab allocator initialisation failed !\n");
+      exit(-1);
+    }
+
+    int failed = check_handles(obj_size);
+
+    slab_allocator_destroy();
+
+    return failed ? -1 : 0;
+  }
   else {  
     printf("Allocation of %d objects of size %lu with the slab allocator\n", N, obj_size);
     
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <assert.h>
+#include <limits.h>
+#include <stdatomic.h>
 
 #include <sys/mman.h>
 
@@ -11,22 +13,61 @@
 #include "queue.h"
 
 #define DEFAULT_MAX_FREE_SLABS_ALLOWED 5
+//upper bound of the slab size considered by objs_cache_plan() when none is given
+#define DEFAULT_MAX_PAGES_PER_SLAB 8
+#define INITIAL_SLAB_TABLE_SIZE 16
+//id of a slab which is not in the slab table of its cache
+#define NO_SLAB_ID UINT_MAX
+//maximum number of empty slabs kept by the pool shared by all the caches
+#define SLAB_POOL_SIZE 64
 
 #define ROUNDUP(x,align) ({ ((x/align) + (x % align ? 1UL : 0UL))*align;})
 #define ROUNDDOWN(x, align) ({ (x/align)*align;})
 #define MAX(a,b) (((a) > (b))? (a) : (b))
 
-static struct Obj * initialize_page_free_objs_list(void *pg,
-						   size_t pg_sz,
-						   struct Obj *first_obj,
-						   size_t obj_sz);
-static struct Userland_slab * create_slab(unsigned int pgs_per_slab,
-					  size_t pg_sz,
-					  size_t actual_obj_sz,
-					  struct Objs_cache *cache_slab_descr);
-static void destroy_slab(struct Userland_slab *slab, size_t slab_sz);
-static void * alloc_obj_from_slab(struct Userland_slab *slab);
-static void free_obj_from_slab(struct Userland_slab *slab, struct Obj *obj);
+//offsets of the free objects of a slab of COMPACT_OBJS cache are stored on 16 bits
+#define MAX_COMPACT_SLAB_SIZE 65536
+
+static struct Obj * get_next_free_obj(const struct Objs_cache *cache,
+				      const struct Userland_slab *slab,
+				      const struct Obj *obj);
+static void set_next_free_obj(const struct Objs_cache *cache,
+			      const struct Userland_slab *slab,
+			      struct Obj *obj,
+			      const struct Obj *next);
+static struct Obj * initialize_page_free_objs_list(const struct Objs_cache *cache,
+						   const struct Userland_slab *slab,
+						   void *pg,
+						   struct Obj *first_obj);
+static struct Slab_plan * compute_slab_geometry(struct Slab_plan *plan,
+						size_t obj_size,
+						size_t align,
+						unsigned int pages_per_slab,
+						unsigned int flags,
+						size_t pg_sz);
+static void * get_slab_pages(size_t slab_sz);
+static void put_slab_pages(void *pgs, size_t slab_sz);
+static struct Userland_slab * create_slab(const struct Objs_cache *cache);
+static void initialize_slab_free_objs_list(const struct Objs_cache *cache,
+					   struct Userland_slab *slab);
+static struct Obj * get_slab_obj(const struct Objs_cache *cache,
+				 const struct Userland_slab *slab,
+				 unsigned int idx);
+static unsigned int get_slab_obj_idx(const struct Objs_cache *cache,
+				     const struct Userland_slab *slab,
+				     const void *obj);
+static int register_slab(struct Objs_cache *cache, struct Userland_slab *slab);
+static void unregister_slab(struct Objs_cache *cache, struct Userland_slab *slab);
+static unsigned int get_obj_generation(const struct Objs_cache *cache,
+				       unsigned int id,
+				       unsigned int idx);
+static void destroy_slab(struct Objs_cache *cache, struct Userland_slab *slab);
+static void reset_slab(const struct Objs_cache *cache, struct Userland_slab *slab);
+static void * alloc_obj_from_slab(const struct Objs_cache *cache,
+				  struct Userland_slab *slab);
+static void free_obj_from_slab(const struct Objs_cache *cache,
+			       struct Userland_slab *slab,
+			       struct Obj *obj);
 static struct Userland_slab * get_owning_slab(void *obj, size_t pg_sz);
 
 /*******************************************************
@@ -48,6 +89,26 @@ static struct Userland_slab * get_owning_slab(void *obj, size_t pg_sz);
 //cache used to allocate Userland_slab objects
 static struct Objs_cache cache_Userland_slab;
 
+/* The pages of the slabs destroyed by the caches are kept in a pool shared
+   by all the caches, from where the pages of new slabs of the same size are
+   taken before asking the system for new pages.
+   Unless disabled, the system is told it can reclaim the pooled pages
+   (MADV_FREE) so that they don't count as used memory.
+*/
+
+struct Pooled_slab{
+  void *pages;
+  size_t size;
+};
+
+static struct Pooled_slab slab_pool[SLAB_POOL_SIZE];
+static unsigned int slab_pool_count = 0;
+//slots reserved for slabs whose pages are being advised free
+static unsigned int slab_pool_reserved_count = 0;
+static unsigned int slab_pool_max_count = SLAB_POOL_SIZE;
+static int slab_pool_advise_free = 1;
+static atomic_flag slab_pool_lock = ATOMIC_FLAG_INIT;
+
 /********************************************************
  *                       Private methods
  *******************************************************/
@@ -57,18 +118,57 @@ static struct Userland_slab * get_owning_slab(void *obj, size_t pg_sz)
   return *((struct Userland_slab**)ROUNDDOWN((uintptr_t)obj, pg_sz)); 
 }
 
-/* Initialize the linked list of free objects of a given page.
+/* In a cache with the flag COMPACT_OBJS, a free object stores the offset
+ * of the next free object from the beginning of its slab on 16 bits
+ * instead of a pointer, 0 standing for the end of the list.
+ * NB: objects are only aligned on the alignment of their cache, which may be
+ * smaller than the one of a pointer (or of 16 bits), so the links are copied
+ * with memcpy().
+ */
+static struct Obj * get_next_free_obj(const struct Objs_cache *cache,
+				      const struct Userland_slab *slab,
+				      const struct Obj *obj)
+{
+  if (cache->flags & COMPACT_OBJS) {
+    uint16_t offset;
+    memcpy(&offset, obj, sizeof(offset));
+    return (offset == 0) ? NULL : (struct Obj*)((uintptr_t)slab->pages + offset);
+  }
+
+  struct Obj *next;
+  //the link is the first member of a free object (header.if_free.next)
+  memcpy(&next, obj, sizeof(next));
+  return next;
+}
+
+static void set_next_free_obj(const struct Objs_cache *cache,
+			      const struct Userland_slab *slab,
+			      struct Obj *obj,
+			      const struct Obj *next)
+{
+  if (cache->flags & COMPACT_OBJS) {
+    uint16_t offset = (next == NULL) ? 0 : (uintptr_t)next - (uintptr_t)slab->pages;
+    memcpy(obj, &offset, sizeof(offset));
+  }
+  else {
+    memcpy(obj, &next, sizeof(next));
+  }
+}
+
+/* Initialize the linked list of free objects of a given page of a slab.
  * The first free objects in the page (all the following
  * objects are assumed to be free too) is given as parameter
  * first_obj.
  * Return the last object of the linked list of free
  * objects.
  */
-static struct Obj* initialize_page_free_objs_list(void *pg,
-						  size_t pg_size,
-						  struct Obj *first_obj,
-						  size_t obj_size)
+static struct Obj* initialize_page_free_objs_list(const struct Objs_cache *cache,
+						  const struct Userland_slab *slab,
+						  void *pg,
+						  struct Obj *first_obj)
 {
+  size_t pg_size = cache->page_size;
+  size_t obj_size = cache->actual_obj_size;
 
   assert(pg != NULL);
   assert(first_obj != NULL);
@@ -80,56 +180,217 @@ static struct Obj* initialize_page_free_objs_list(void *pg,
 
   while ((uintptr_t)next_obj + obj_size - (uintptr_t)pg <= pg_size) {
     next_obj = (struct Obj*)((uintptr_t)current_obj + obj_size);
-    current_obj->header.if_free.next = next_obj;
+    set_next_free_obj(cache, slab, current_obj, next_obj);
 
     if ((uintptr_t)next_obj + obj_size - (uintptr_t)pg <= pg_size)
       current_obj = next_obj;
   }
   
-  current_obj->header.if_free.next = NULL;
+  set_next_free_obj(cache, slab, current_obj, NULL);
 
   return current_obj;
 }
 
-/* Create a new slab to be added to a cache.
- * pgs_per_slab : the number of pages used by this slab
- * pg_sz : the size in bytes of a page
- * obj_sz : (actual) size of an object
- * cache_slab_descr : if non null, the cache from where to allocate the slab descriptor
- * instead of storing it at the beginning of the slab.
+static void lock_slab_pool(void)
+{
+  while (atomic_flag_test_and_set_explicit(&slab_pool_lock, memory_order_acquire))
+    ;
+}
+
+static void unlock_slab_pool(void)
+{
+  atomic_flag_clear_explicit(&slab_pool_lock, memory_order_release);
+}
+
+/* Return the pages of a new slab of slab_sz bytes, taken from the pool
+ * of empty slabs if possible.
+ * NB: unlike new pages, the pages taken from the pool are not cleared.
+ * Return NULL on failure.
+ */
+static void * get_slab_pages(size_t slab_sz)
+{
+  void *pgs = NULL;
+
+  lock_slab_pool();
+  for (unsigned int i = slab_pool_count; i > 0; i--) {
+    if (slab_pool[i - 1].size == slab_sz) {
+      pgs = slab_pool[i - 1].pages;
+      slab_pool[i - 1] = slab_pool[--slab_pool_count];
+      break;
+    }
+  }
+  unlock_slab_pool();
+
+  if (pgs != NULL)
+    return pgs;
+
+  pgs = mmap(NULL,
+	     slab_sz,
+	     PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS, 
+	     -1,
+	     0);
+
+  return (pgs == MAP_FAILED) ? NULL : pgs;
+}
+
+/* Give the pages of a destroyed slab to the pool of empty slabs,
+ * or back to the system if the pool is full.
+ */
+static void put_slab_pages(void *pgs, size_t slab_sz)
+{
+  int advise_free;
+
+  lock_slab_pool();
+  if (slab_pool_count + slab_pool_reserved_count >= slab_pool_max_count) {
+    unlock_slab_pool();
+    munmap(pgs, slab_sz);
+    return;
+  }
+
+  advise_free = slab_pool_advise_free;
+  if (advise_free)
+    //the pages can't be pooled before being advised, otherwise they could be reused meanwhile
+    slab_pool_reserved_count++;
+  unlock_slab_pool();
+
+  if (advise_free) {
+#ifdef MADV_FREE
+    madvise(pgs, slab_sz, MADV_FREE);
+#else
+    madvise(pgs, slab_sz, MADV_DONTNEED);
+#endif
+    lock_slab_pool();
+    slab_pool_reserved_count--;
+  }
+
+  //NB: slab_pool_count + slab_pool_reserved_count <= SLAB_POOL_SIZE, so there is room
+  slab_pool[slab_pool_count].pages = pgs;
+  slab_pool[slab_pool_count].size = slab_sz;
+  slab_pool_count++;
+  unlock_slab_pool();
+}
+
+/* Give back to the system the pooled slabs beyond max_count.
+ */
+static void trim_slab_pool(unsigned int max_count)
+{
+  struct Pooled_slab pooled;
+
+  for (;;) {
+    lock_slab_pool();
+    if (slab_pool_count <= max_count) {
+      unlock_slab_pool();
+      return;
+    }
+    pooled = slab_pool[--slab_pool_count];
+    unlock_slab_pool();
+
+    munmap(pooled.pages, pooled.size);
+  }
+}
+
+/* Return the default alignment of objects of obj_size bytes : the biggest
+ * power of 2 dividing obj_size, up to the size of a pointer.
+ */
+static size_t natural_alignment(size_t obj_size)
+{
+  size_t align = 1;
+
+  while (align < sizeof(void*) && obj_size % (align*2) == 0)
+    align *= 2;
+
+  return align;
+}
+
+/* Compute the geometry of a slab made of pages_per_slab pages of pg_sz bytes
+ * holding objects of obj_size bytes aligned on align bytes.
+ * flags : the flags of the cache (SLAB_DESCR_ON_SLAB...)
+ * Return plan if at least one object fits in each page of the slab, NULL otherwise.
+ */
+static struct Slab_plan * compute_slab_geometry(struct Slab_plan *plan,
+						size_t obj_size,
+						size_t align,
+						unsigned int pages_per_slab,
+						unsigned int flags,
+						size_t pg_sz)
+{
+  assert(plan != NULL);
+  assert(align > 0);
+
+  size_t pg_metadata_sz = sizeof(struct Userland_slab *);
+  int on_slab_descriptor = (flags & SLAB_DESCR_ON_SLAB);
+
+  if (pages_per_slab == 0)
+    return NULL;
+
+  plan->obj_size = obj_size;
+  plan->align = align;
+  //when an object is free, its bytes are used as a pointer (or a 16 bits offset
+  //if COMPACT_OBJS) to the next free object so an object has to be at least
+  //big enough to store this pointer
+  size_t actual_obj_size = MAX(obj_size, (flags & COMPACT_OBJS) ? sizeof(uint16_t) : sizeof(void*));
+  plan->actual_obj_size = ROUNDUP(actual_obj_size, align);
+  plan->flags = flags;
+
+  plan->pages_per_slab = pages_per_slab;
+  plan->page_size = pg_sz;
+  plan->slab_size = pages_per_slab*pg_sz;
+
+  if ((flags & COMPACT_OBJS) && plan->slab_size > MAX_COMPACT_SLAB_SIZE)
+    return NULL;
+
+  //the slab descriptor, if on-slab, follows the metadata of the first page
+  size_t first_page_offset = pg_metadata_sz + (on_slab_descriptor ? sizeof(struct Userland_slab) : 0);
+  plan->first_page_offset = ROUNDUP(first_page_offset, align);
+  plan->page_offset = ROUNDUP(pg_metadata_sz, align);
+
+  if (plan->first_page_offset + plan->actual_obj_size > pg_sz)
+    return NULL;
+
+  plan->objs_first_page = (pg_sz - plan->first_page_offset) / plan->actual_obj_size;
+  plan->objs_per_page = (pg_sz - plan->page_offset) / plan->actual_obj_size;
+  plan->objs_per_slab = plan->objs_first_page + plan->objs_per_page * (pages_per_slab - 1);
+
+  plan->wasted_memory_per_slab = plan->slab_size - plan->objs_per_slab * obj_size;
+  if ( !on_slab_descriptor)
+    plan->wasted_memory_per_slab += sizeof(struct Userland_slab);
+
+  return plan;
+}
+
+/* Create a new slab to be added to cache.
+ * The slab descriptor is stored at the beginning of the slab if the cache
+ * has the flag SLAB_DESCR_ON_SLAB, otherwise it is allocated from
+ * cache->cache_slab_descr.
  * Return this adress of the new slab's descriptor if successful, NULL otherwise
  */
-static struct Userland_slab *create_slab(unsigned int pgs_per_slab,
-					 size_t pg_sz,
-					 size_t obj_sz,
-					 struct Objs_cache *cache_slab_descr)
+static struct Userland_slab *create_slab(const struct Objs_cache *cache)
 {
-  assert(pgs_per_slab > 0);
+  assert(cache->pages_per_slab > 0);
 
   size_t pg_metadata_sz = sizeof(struct Userland_slab *);
-  int on_slab_descriptor = (cache_slab_descr == NULL);
+  int on_slab_descriptor = (cache->flags & SLAB_DESCR_ON_SLAB);
   
   struct Userland_slab *new_slab_descr = NULL;
-  size_t slab_sz = pgs_per_slab*pg_sz;
+  size_t pg_sz = cache->page_size;
 
 
-  void *new_slab_pgs = mmap(NULL,
-			    slab_sz,
-			    PROT_READ | PROT_WRITE,
-			    MAP_PRIVATE | MAP_ANONYMOUS, 
-			    -1,
-			    0);
-  //NB: the pages don't have to be cleared since MAP_ANONYMOUS flag implies they are initialised to 0
+  void *new_slab_pgs = get_slab_pages(cache->slab_size);
+  //NB: the pages don't have to be cleared, all the metadata of the slab are initialised below
   
-  if (new_slab_pgs == MAP_FAILED)
+  if (new_slab_pgs == NULL)
     return NULL;
 
   if (!on_slab_descriptor) {
     //off-slab slab descriptor
-    new_slab_descr = objs_cache_alloc(cache_slab_descr);
+    //NB: the cache of slab descriptors is shared by the caches of all the threads
+    objs_cache_lock(cache->cache_slab_descr);
+    new_slab_descr = objs_cache_alloc(cache->cache_slab_descr);
+    objs_cache_unlock(cache->cache_slab_descr);
 
     if (new_slab_descr == NULL) {
-      munmap(new_slab_pgs, slab_sz);
+      put_slab_pages(new_slab_pgs, cache->slab_size);
       return NULL;
     }
   }
@@ -140,77 +401,241 @@ static struct Userland_slab *create_slab(unsigned int pgs_per_slab,
   }
 
   new_slab_descr->pages = new_slab_pgs;
+  new_slab_descr->id = NO_SLAB_ID;
+  new_slab_descr->prev = NULL;
+  new_slab_descr->next = NULL;
   
   //At the beginning of each page we define a pointer to the slab descriptor to which this page belongs
   struct Userland_slab **ptr = new_slab_pgs;
-  for (unsigned int i = 0; i < pgs_per_slab; i++) {
+  for (unsigned int i = 0; i < cache->pages_per_slab; i++) {
     *ptr = new_slab_descr;
     ptr = (struct Userland_slab **)((uintptr_t)ptr + pg_sz);
   }
   
-  unsigned int free_objs_first_pg = (pg_sz - pg_metadata_sz - (on_slab_descriptor ? sizeof(struct Userland_slab) : 0)) / obj_sz;
-  unsigned int free_objs_pg = (pg_sz - pg_metadata_sz) / obj_sz;
+  new_slab_descr->free_objs_count = cache->objs_per_slab;
 
-  new_slab_descr->free_objs_count = free_objs_first_pg + (pgs_per_slab - 1) * free_objs_pg;
+  new_slab_descr->objs = (struct Obj*)((uintptr_t)new_slab_pgs + cache->first_page_offset);
+  new_slab_descr->first_free_obj = NULL;
 
-  new_slab_descr->first_free_obj = (struct Obj*)((uintptr_t)new_slab_pgs + pg_metadata_sz + (on_slab_descriptor ? sizeof(struct Userland_slab) : 0));
-  new_slab_descr->objs = new_slab_descr->first_free_obj;
+  //objects of an arena are handed out in order, without list of free objects
+  if ( !(cache->flags & ARENA_OBJS))
+    initialize_slab_free_objs_list(cache, new_slab_descr);
 
-  
-  //we set up the linked list of free objects
+  return new_slab_descr;
+}
 
-  struct Obj *current_obj = new_slab_descr->first_free_obj;
+/* Set up the linked list of all the objects of a slab, which are assumed
+ * to be free.
+ */
+static void initialize_slab_free_objs_list(const struct Objs_cache *cache,
+					   struct Userland_slab *slab)
+{
+  assert(slab != NULL);
+
+  struct Obj *current_obj = slab->objs;
   struct Obj *last_obj = NULL;
   
-  void *pg = new_slab_pgs;
+  void *pg = slab->pages;
+
+  slab->first_free_obj = current_obj;
   
-  for (unsigned int i = 1; i <= pgs_per_slab; i++) {
-    last_obj = initialize_page_free_objs_list(pg,
-					      pg_sz,
-					      current_obj,
-					      obj_sz);
-    if (i < pgs_per_slab) {
-      pg = (void*)((uintptr_t)pg + pg_sz);
-      current_obj = (struct Obj*)((uintptr_t)pg + pg_metadata_sz);
-      last_obj->header.if_free.next = current_obj;
+  for (unsigned int i = 1; i <= cache->pages_per_slab; i++) {
+    last_obj = initialize_page_free_objs_list(cache,
+					      slab,
+					      pg,
+					      current_obj);
+    if (i < cache->pages_per_slab) {
+      pg = (void*)((uintptr_t)pg + cache->page_size);
+      current_obj = (struct Obj*)((uintptr_t)pg + cache->page_offset);
+      set_next_free_obj(cache, slab, last_obj, current_obj);
     }
   }
+}
 
-  return new_slab_descr;
+/* Return the idx-th object of a slab of cache.
+ */
+static struct Obj * get_slab_obj(const struct Objs_cache *cache,
+				 const struct Userland_slab *slab,
+				 unsigned int idx)
+{
+  assert(idx < cache->objs_per_slab);
+
+  if (idx < cache->objs_first_page)
+    return (struct Obj*)((uintptr_t)slab->objs + idx * cache->actual_obj_size);
+
+  idx -= cache->objs_first_page;
+
+  unsigned int pg_idx = 1 + idx / cache->objs_per_page;
+  uintptr_t pg = (uintptr_t)slab->pages + pg_idx * cache->page_size;
+
+  return (struct Obj*)(pg + cache->page_offset + (idx % cache->objs_per_page) * cache->actual_obj_size);
+}
+
+/* Return the index in its slab of an object of cache (see get_slab_obj()).
+ */
+static unsigned int get_slab_obj_idx(const struct Objs_cache *cache,
+				     const struct Userland_slab *slab,
+				     const void *obj)
+{
+  uintptr_t offset = (uintptr_t)obj - (uintptr_t)slab->pages;
+  unsigned int pg_idx = offset / cache->page_size;
+  size_t pg_offset = offset % cache->page_size;
+
+  if (pg_idx == 0)
+    return (pg_offset - cache->first_page_offset) / cache->actual_obj_size;
+
+  return cache->objs_first_page
+    + (pg_idx - 1) * cache->objs_per_page
+    + (pg_offset - cache->page_offset) / cache->actual_obj_size;
+}
+
+/* Give an id to a new slab of a cache allocating handles and add it
+ * to the slab table of the cache. The ids of destroyed slabs are reused.
+ * Return 1 on success, 0 if the slab table is full or can't grow.
+ */
+static int register_slab(struct Objs_cache *cache, struct Userland_slab *slab)
+{
+  assert(cache->slab_table != NULL);
+
+  unsigned int id;
+
+  if (cache->slab_table_free_id != NO_SLAB_ID) {
+    id = cache->slab_table_free_id;
+    cache->slab_table_free_id = cache->slab_table[id].next_free_id;
+  }
+  else {
+    //id 0 is kept for OBJ_HANDLE_NULL
+    unsigned int max_slabs = (1U << (32 - cache->handle_obj_bits - cache->handle_gen_bits)) - 1;
+
+    if (cache->slab_table_len >= max_slabs)
+      return 0;
+
+    if (cache->slab_table_len == cache->slab_table_size) {
+      unsigned int new_size = cache->slab_table_size * 2;
+      struct Slab_table_entry *new_table = realloc(cache->slab_table,
+						   new_size * sizeof(struct Slab_table_entry));
+      if (new_table == NULL)
+	return 0;
+
+      cache->slab_table = new_table;
+      cache->slab_table_size = new_size;
+    }
+
+    id = cache->slab_table_len;
+    cache->slab_table[id].generations = NULL;
+    cache->slab_table[id].generation_base = 0;
+
+    if (cache->handle_gen_bits) {
+      cache->slab_table[id].generations = calloc(cache->objs_per_slab, sizeof(uint8_t));
+      if (cache->slab_table[id].generations == NULL)
+	return 0;
+    }
+
+    cache->slab_table_len++;
+  }
+
+  cache->slab_table[id].slab = slab;
+  slab->id = id;
+
+  return 1;
+}
+
+/* Return the generation of the idx-th object of the slab of a given id,
+ * truncated to the generation bits of the handles of cache.
+ */
+static unsigned int get_obj_generation(const struct Objs_cache *cache,
+				       unsigned int id,
+				       unsigned int idx)
+{
+  const struct Slab_table_entry *entry = &cache->slab_table[id];
+
+  return (entry->generation_base + entry->generations[idx]) & ((1U << cache->handle_gen_bits) - 1);
 }
 
-static void destroy_slab(struct Userland_slab *slab, size_t slab_sz)
+static void unregister_slab(struct Objs_cache *cache, struct Userland_slab *slab)
+{
+  if (slab->id != NO_SLAB_ID) {
+    cache->slab_table[slab->id].slab = NULL;
+    cache->slab_table[slab->id].next_free_id = cache->slab_table_free_id;
+    cache->slab_table_free_id = slab->id;
+    slab->id = NO_SLAB_ID;
+  }
+}
+
+/* Give the pages of a slab of cache to the pool of empty slabs, and its
+ * descriptor to cache->cache_slab_descr if it is off-slab.
+ */
+static void destroy_slab(struct Objs_cache *cache, struct Userland_slab *slab)
 {
   assert(slab != NULL);
-  munmap(slab, slab_sz);
+
+  void *pgs = slab->pages;
+
+  unregister_slab(cache, slab);
+
+  if ( !(cache->flags & SLAB_DESCR_ON_SLAB)) {
+    objs_cache_lock(cache->cache_slab_descr);
+    objs_cache_free(cache->cache_slab_descr, slab);
+    objs_cache_unlock(cache->cache_slab_descr);
+  }
+
+  put_slab_pages(pgs, cache->slab_size);
 }
 
+/* Mark all the objects of a slab as free without visiting them,
+ * its list of free objects is rebuilt when the slab is used again.
+ */
+static void reset_slab(const struct Objs_cache *cache, struct Userland_slab *slab)
+{
+  assert(slab != NULL);
 
-static void *alloc_obj_from_slab(struct Userland_slab *slab)
+  slab->free_objs_count = cache->objs_per_slab;
+  slab->first_free_obj = NULL;
+
+  //handles to the objects of the slab become stale
+  if (cache->handle_gen_bits)
+    cache->slab_table[slab->id].generation_base++;
+}
+
+
+static void *alloc_obj_from_slab(const struct Objs_cache *cache,
+				 struct Userland_slab *slab)
 {
   assert(slab != NULL);
-  assert(slab->first_free_obj != NULL);
-  
   assert(slab->free_objs_count > 0);
+
+  if (cache->flags & ARENA_OBJS) {
+    struct Obj *obj = get_slab_obj(cache, slab, cache->objs_per_slab - slab->free_objs_count);
+    slab->free_objs_count--;
+    return obj;
+  }
+
+  //the slab has been reset, its list of free objects has to be rebuilt
+  if (slab->first_free_obj == NULL)
+    initialize_slab_free_objs_list(cache, slab);
+
+  assert(slab->first_free_obj != NULL);
 	  
   struct Obj *obj =slab->first_free_obj;
 
   slab->free_objs_count--;
       
   //remove this object from the list of free objects
-  slab->first_free_obj = obj->header.if_free.next;
-  obj->header.if_free.next = NULL;
+  slab->first_free_obj = get_next_free_obj(cache, slab, obj);
+  set_next_free_obj(cache, slab, obj, NULL);
 
   return obj; 
 }
 
-static void free_obj_from_slab(struct Userland_slab *slab, struct Obj *obj)
+static void free_obj_from_slab(const struct Objs_cache *cache,
+			       struct Userland_slab *slab,
+			       struct Obj *obj)
 {
   assert(slab != NULL);
   assert(obj != NULL);
 
   slab->free_objs_count++;
-  obj->header.if_free.next = slab->first_free_obj;
+  set_next_free_obj(cache, slab, obj, slab->first_free_obj);
   slab->first_free_obj = obj;
 }
 
@@ -220,7 +645,9 @@ static void default_slab_freeing_policy(struct Objs_cache *cache)
     struct Userland_slab *slab = cache->free_slabs;
     for (;cache->free_slabs_count > DEFAULT_MAX_FREE_SLABS_ALLOWED; cache->free_slabs_count--) {
       slab = dlist_pop_head_generic(cache->free_slabs, prev, next);
-      destroy_slab(slab, cache->slab_size);
+      destroy_slab(cache, slab);
+      cache->slab_count--;
+      cache->free_objs_count -= cache->objs_per_slab;
     }
   }
 }
@@ -244,9 +671,87 @@ int slab_allocator_init(void)
 void slab_allocator_destroy(void)
 {
   objs_cache_destroy(&cache_Userland_slab);
+  trim_slab_pool(0);
 }
 
-/* Initialize a cache
+/* Set the maximum number of empty slabs (at most SLAB_POOL_SIZE) kept by
+ * the pool shared by all the caches, and whether the system is allowed to
+ * reclaim their pages.
+ */
+void slab_allocator_configure_pool(unsigned int max_pooled_slabs, int advise_free)
+{
+  if (max_pooled_slabs > SLAB_POOL_SIZE)
+    max_pooled_slabs = SLAB_POOL_SIZE;
+
+  lock_slab_pool();
+  slab_pool_max_count = max_pooled_slabs;
+  slab_pool_advise_free = advise_free;
+  unlock_slab_pool();
+
+  trim_slab_pool(max_pooled_slabs);
+}
+
+/* Compute the geometry of the slabs of a cache of objects of obj_size bytes
+ * aligned on align bytes (0 for the natural alignment of obj_size).
+ * Every slab size up to max_slab_size bytes (0 for the default maximum),
+ * with either on-slab or off-slab descriptors, and for objects smaller than
+ * a pointer with or without COMPACT_OBJS, is evaluated and the geometry
+ * wasting the least memory per object is kept. On a tie, the smallest slab
+ * and then the on-slab descriptor are prefered.
+ *
+ * Return plan on success, NULL if no geometry fits.
+ */
+struct Slab_plan * objs_cache_plan(struct Slab_plan *plan,
+				   size_t obj_size,
+				   size_t align,
+				   size_t max_slab_size)
+{
+  if (plan == NULL)
+    return NULL;
+
+  size_t pg_sz = sysconf(_SC_PAGESIZE);
+
+  if (align == 0)
+    align = natural_alignment(obj_size);
+
+  //objects are aligned relatively to the beginning of their page
+  if ((align & (align - 1)) || align > pg_sz)
+    return NULL;
+
+  if (max_slab_size == 0)
+    max_slab_size = DEFAULT_MAX_PAGES_PER_SLAB * pg_sz;
+
+  const unsigned int descr_flags[] = {SLAB_DESCR_ON_SLAB,
+				      0,
+				      SLAB_DESCR_ON_SLAB | COMPACT_OBJS,
+				      COMPACT_OBJS};
+  unsigned int max_pages_per_slab = max_slab_size / pg_sz;
+  struct Slab_plan candidate;
+  int found = 0;
+
+  for (unsigned int pages = 1; pages <= max_pages_per_slab; pages++) {
+    for (unsigned int i = 0; i < sizeof(descr_flags)/sizeof(descr_flags[0]); i++) {
+      //compact objects only save memory when they are smaller than a pointer
+      if ((descr_flags[i] & COMPACT_OBJS) && obj_size >= sizeof(void*))
+	continue;
+
+      if ( !compute_slab_geometry(&candidate, obj_size, align, pages, descr_flags[i], pg_sz))
+	continue;
+
+      //candidate.wasted / candidate.objs < plan.wasted / plan.objs
+      if ( !found
+	   || (unsigned long long)candidate.wasted_memory_per_slab * plan->objs_per_slab
+	   < (unsigned long long)plan->wasted_memory_per_slab * candidate.objs_per_slab) {
+	*plan = candidate;
+	found = 1;
+      }
+    }
+  }
+
+  return found ? plan : NULL;
+}
+
+/* Initialize a cache, the geometry of its slabs is chosen by objs_cache_plan().
  *
  *
  * Return cache on success, NULL otherwise
@@ -255,12 +760,15 @@ struct Objs_cache * objs_cache_init(struct Objs_cache *cache,
 				    size_t obj_size,
 				    void (*ctor)(void *))
 {
-  return _objs_cache_init(cache,
-			  obj_size,
-			  1,
-			  0,
-			  ctor,
-			  NULL);
+  struct Slab_plan plan;
+
+  if (objs_cache_plan(&plan, obj_size, 0, 0) == NULL)
+    return NULL;
+
+  return objs_cache_init_with_plan(cache,
+				   &plan,
+				   ctor,
+				   NULL);
 }
 
 struct Objs_cache * _objs_cache_init(struct Objs_cache *cache,
@@ -270,15 +778,69 @@ struct Objs_cache * _objs_cache_init(struct Objs_cache *cache,
 				     void (*ctor)(void *),
 				     void (*slab_freeing_policy)(struct Objs_cache*))
 {
+  struct Slab_plan plan;
+
+  if (compute_slab_geometry(&plan,
+			    obj_size,
+			    1,
+			    pages_per_slab,
+			    flags,
+			    sysconf(_SC_PAGESIZE)) == NULL)
+    return NULL;
+
+  return objs_cache_init_with_plan(cache,
+				   &plan,
+				   ctor,
+				   slab_freeing_policy);
+}
+
+/* Return 1 if the geometries of plans a and b are the same, 0 otherwise.
+ */
+static int is_same_geometry(const struct Slab_plan *a, const struct Slab_plan *b)
+{
+  return a->actual_obj_size == b->actual_obj_size
+    && a->slab_size == b->slab_size
+    && a->first_page_offset == b->first_page_offset
+    && a->page_offset == b->page_offset
+    && a->objs_first_page == b->objs_first_page
+    && a->objs_per_page == b->objs_per_page
+    && a->objs_per_slab == b->objs_per_slab
+    && a->wasted_memory_per_slab == b->wasted_memory_per_slab;
+}
+
+/* Initialize a cache whose slabs follow the geometry given by plan
+ * (see objs_cache_plan()). The geometry is computed again from the
+ * object size, alignment, pages per slab and flags of plan, so that
+ * only flags which don't change it (ARENA_OBJS) may be changed in a
+ * plan computed by objs_cache_plan().
+ *
+ * Return cache on success, NULL otherwise (e.g. plan inconsistent)
+ */
+struct Objs_cache * objs_cache_init_with_plan(struct Objs_cache *cache,
+					      const struct Slab_plan *plan,
+					      void (*ctor)(void *),
+					      void (*slab_freeing_policy)(struct Objs_cache*))
+{
+
+  struct Slab_plan checked_plan;
 
-  if (cache == NULL || pages_per_slab == 0)
+  if (cache == NULL || plan == NULL || plan->align == 0)
+    return NULL;
+
+  if (plan->page_size != (size_t)sysconf(_SC_PAGESIZE)
+      || compute_slab_geometry(&checked_plan,
+			       plan->obj_size,
+			       plan->align,
+			       plan->pages_per_slab,
+			       plan->flags,
+			       plan->page_size) == NULL
+      || !is_same_geometry(plan, &checked_plan))
     return NULL;
   
-  cache->obj_size = obj_size;
-  //when an object is free, its bytes are used as a pointer to the next free object
-  //so an object has to be at least the big enough to store this pointer
-  cache->actual_obj_size = MAX(obj_size, sizeof(void*));
-  cache->flags = flags;
+  cache->obj_size = plan->obj_size;
+  cache->actual_obj_size = plan->actual_obj_size;
+  cache->align = plan->align;
+  cache->flags = plan->flags;
   cache->ctor = ctor;
 
   if (slab_freeing_policy == NULL)
@@ -286,22 +848,24 @@ struct Objs_cache * _objs_cache_init(struct Objs_cache *cache,
   else
     cache->slab_freeing_policy = slab_freeing_policy;
   
-  if ( !(flags & SLAB_DESCR_ON_SLAB))
+  if ( !(plan->flags & SLAB_DESCR_ON_SLAB))
     cache->cache_slab_descr = &cache_Userland_slab;
+  else
+    cache->cache_slab_descr = NULL;
       
-  cache->pages_per_slab = pages_per_slab;
-  cache->page_size = sysconf(_SC_PAGESIZE);
-  cache->slab_size = cache->pages_per_slab*cache->page_size;
+  cache->pages_per_slab = plan->pages_per_slab;
+  cache->page_size = plan->page_size;
+  cache->slab_size = plan->slab_size;
 
-  size_t pg_metadata_sz = sizeof(void*);
-  unsigned int free_objs_first_pg = (cache->page_size - pg_metadata_sz - (flags & SLAB_DESCR_ON_SLAB ? sizeof(struct Userland_slab) : 0)) / cache->actual_obj_size;
-  unsigned int free_objs_pg = (cache->page_size - pg_metadata_sz) / cache->actual_obj_size;
-  
-  //cache->objs_per_slab = free_objs_pg + free_objs_first_pg * (cache->pages_per_slab - 1);;
-  cache->objs_per_slab = free_objs_first_pg + free_objs_pg * (cache->pages_per_slab - 1);
+  cache->first_page_offset = plan->first_page_offset;
+  cache->page_offset = plan->page_offset;
+
+  cache->objs_first_page = plan->objs_first_page;
+  cache->objs_per_page = plan->objs_per_page;
+  cache->objs_per_slab = plan->objs_per_slab;
 
-  cache->wasted_memory_per_page = cache->page_size % cache->actual_obj_size;
-  cache->wasted_memory_per_slab = cache->wasted_memory_per_page * cache->pages_per_slab;
+  cache->wasted_memory_per_page = cache->page_size - cache->page_offset - cache->objs_per_page * cache->actual_obj_size;
+  cache->wasted_memory_per_slab = plan->wasted_memory_per_slab;
 
   cache->free_objs_count = 0;
   cache->used_objs_count = 0;
@@ -315,9 +879,40 @@ struct Objs_cache * _objs_cache_init(struct Objs_cache *cache,
   cache->partial_slabs = NULL;
   cache->full_slabs = NULL;
 
+  cache->slab_table = NULL;
+  cache->slab_table_size = 0;
+  cache->slab_table_len = 0;
+  cache->slab_table_free_id = NO_SLAB_ID;
+
+  cache->handle_obj_bits = 0;
+  cache->handle_gen_bits = 0;
+
+  atomic_flag_clear(&cache->lock);
+
   return cache;
 }
 
+/* Fill plan with the geometry of the slabs of cache.
+ */
+void objs_cache_get_plan(const struct Objs_cache *cache, struct Slab_plan *plan)
+{
+  if (cache != NULL && plan != NULL) {
+    plan->obj_size = cache->obj_size;
+    plan->align = cache->align;
+    plan->actual_obj_size = cache->actual_obj_size;
+    plan->flags = cache->flags;
+    plan->pages_per_slab = cache->pages_per_slab;
+    plan->page_size = cache->page_size;
+    plan->slab_size = cache->slab_size;
+    plan->first_page_offset = cache->first_page_offset;
+    plan->page_offset = cache->page_offset;
+    plan->objs_first_page = cache->objs_first_page;
+    plan->objs_per_page = cache->objs_per_page;
+    plan->objs_per_slab = cache->objs_per_slab;
+    plan->wasted_memory_per_slab = cache->wasted_memory_per_slab;
+  }
+}
+
 void objs_cache_destroy(struct Objs_cache *cache)
 {
   if (cache != NULL) {
@@ -326,23 +921,30 @@ void objs_cache_destroy(struct Objs_cache *cache)
     current = cache->free_slabs;
     while (current != NULL) {
       next = current->next;
-      destroy_slab(current, cache->slab_size);
+      destroy_slab(cache, current);
       current = next;
     }
       
     current = cache->partial_slabs;
     while (current != NULL) {
       next = current->next;
-      destroy_slab(current, cache->slab_size);
+      destroy_slab(cache, current);
       current = next;
     }
       
     current = cache->full_slabs;
     while (current != NULL) {
       next = current->next;
-      destroy_slab(current, cache->slab_size);
+      destroy_slab(cache, current);
       current = next;
     }
+
+    if (cache->slab_table != NULL) {
+      for (unsigned int i = 0; i < cache->slab_table_len; i++)
+	free(cache->slab_table[i].generations);
+      free(cache->slab_table);
+      cache->slab_table = NULL;
+    }
   }
 }
 			
@@ -355,7 +957,7 @@ void *objs_cache_alloc(struct Objs_cache *cache)
     if ( !dlist_is_empty_generic(cache->partial_slabs)) {
       struct Userland_slab *slab = cache->partial_slabs;
 	  
-      allocated_obj = alloc_obj_from_slab(slab);
+      allocated_obj = alloc_obj_from_slab(cache, slab);
 	  
       assert(allocated_obj != NULL);
 	  
@@ -378,20 +980,20 @@ void *objs_cache_alloc(struct Objs_cache *cache)
 	
       //do we need to create a new free slab first ?
       if (dlist_is_empty_generic(cache->free_slabs)) {	  
-	if (cache->flags & SLAB_DESCR_ON_SLAB) {
-	  cache->free_slabs = create_slab(cache->pages_per_slab,
-					  cache->page_size,
-					  cache->actual_obj_size,
-					  NULL);
+	struct Userland_slab *new_slab = create_slab(cache);
+
+	if (new_slab == NULL) {
+	  printf("Failed to create a new slab in %s !\n", __func__);
+	  return NULL;
 	}
-	else {
-	  cache->free_slabs = create_slab(cache->pages_per_slab,
-					  cache->page_size,
-					  cache->actual_obj_size,
-					  cache->cache_slab_descr);
+
+	if (cache->slab_table != NULL && !register_slab(cache, new_slab)) {
+	  printf("Failed to add a new slab to the slab table in %s !\n", __func__);
+	  destroy_slab(cache, new_slab);
+	  return NULL;
 	}
-	    
-	assert(cache->free_slabs != NULL);
+
+	dlist_push_head_generic(cache->free_slabs, new_slab, prev, next);
 	    
 	cache->free_slabs_count++;
 	cache->slab_count++;
@@ -401,7 +1003,7 @@ void *objs_cache_alloc(struct Objs_cache *cache)
 
       struct Userland_slab *slab = cache->free_slabs;
 
-      allocated_obj = alloc_obj_from_slab(slab);
+      allocated_obj = alloc_obj_from_slab(cache, slab);
 
       if (allocated_obj == NULL) {
 	printf("Failed to allocate an object in %s (slab corrupted) !\n", __func__);
@@ -442,6 +1044,10 @@ void objs_cache_free(struct Objs_cache *cache, void *obj)
 {
   
   if (cache != NULL && obj != NULL) {
+    //objects of an arena are only given back by objs_cache_reset()
+    if (cache->flags & ARENA_OBJS)
+      return;
+
     struct Userland_slab *slab = get_owning_slab(obj, cache->page_size);
 
     if (slab == NULL) {
@@ -449,7 +1055,12 @@ void objs_cache_free(struct Objs_cache *cache, void *obj)
     }
 
     char slab_was_full = is_slab_full(slab);
-    free_obj_from_slab(slab, obj);
+    free_obj_from_slab(cache, slab, obj);
+
+    //handles to this object become stale
+    if (cache->handle_gen_bits)
+      cache->slab_table[slab->id].generations[get_slab_obj_idx(cache, slab, obj)]++;
+
     char slab_is_now_free = is_slab_empty(slab, cache->objs_per_slab);
 
     cache->free_objs_count++;
@@ -494,6 +1105,175 @@ void objs_cache_free(struct Objs_cache *cache, void *obj)
   }
 }
 
+/* Free all the objects of a cache at once : every slab becomes free
+ * without its objects being visited, so the cost is proportional to the
+ * number of slabs. The objects previously allocated must not be used anymore.
+ */
+void objs_cache_reset(struct Objs_cache *cache)
+{
+  if (cache != NULL) {
+    struct Userland_slab *slab;
+
+    while ( !dlist_is_empty_generic(cache->partial_slabs)) {
+      slab = dlist_pop_head_generic(cache->partial_slabs, prev, next);
+      reset_slab(cache, slab);
+      dlist_push_head_generic(cache->free_slabs, slab, prev, next);
+    }
+
+    while ( !dlist_is_empty_generic(cache->full_slabs)) {
+      slab = dlist_pop_head_generic(cache->full_slabs, prev, next);
+      reset_slab(cache, slab);
+      dlist_push_head_generic(cache->free_slabs, slab, prev, next);
+    }
+
+    cache->free_slabs_count = cache->slab_count;
+    cache->partial_slabs_count = 0;
+    cache->full_slabs_count = 0;
+
+    cache->free_objs_count = cache->slab_count * cache->objs_per_slab;
+    cache->used_objs_count = 0;
+
+    // Try to free some slabs
+    cache->slab_freeing_policy(cache);
+  }
+}
+
+/* Caches are not thread-safe : the threads sharing a cache have to
+ * bracket their calls to objs_cache_alloc(), objs_cache_free()... with
+ * objs_cache_lock()/objs_cache_unlock(). The objects retired with
+ * objs_cache_free_deferred() are freed under this lock.
+ */
+void objs_cache_lock(struct Objs_cache *cache)
+{
+  while (atomic_flag_test_and_set_explicit(&cache->lock, memory_order_acquire))
+    ;
+}
+
+void objs_cache_unlock(struct Objs_cache *cache)
+{
+  atomic_flag_clear_explicit(&cache->lock, memory_order_release);
+}
+
+/* Allow the objects of a cache to be referenced by 32 bits handles
+ * encoding the index of their slab in the slab table of the cache, their
+ * index in their slab and, if generation_bits > 0, a generation number
+ * incremented each time the object is freed so that stale handles
+ * are detected (up to a wrap-around of the generation).
+ * Must be called before any allocation from the cache.
+ * Return 1 on success, 0 otherwise.
+ */
+int objs_cache_enable_handles(struct Objs_cache *cache, unsigned int generation_bits)
+{
+  if (cache == NULL
+      || cache->slab_count != 0
+      || cache->slab_table != NULL
+      || generation_bits > MAX_HANDLE_GENERATION_BITS)
+    return 0;
+
+  unsigned int obj_bits = 1;
+  while ((1UL << obj_bits) < cache->objs_per_slab)
+    obj_bits++;
+
+  //at least one bit has to remain for the slab index
+  if (obj_bits + generation_bits >= 32)
+    return 0;
+
+  cache->slab_table = malloc(INITIAL_SLAB_TABLE_SIZE * sizeof(struct Slab_table_entry));
+  if (cache->slab_table == NULL)
+    return 0;
+
+  cache->slab_table_size = INITIAL_SLAB_TABLE_SIZE;
+  cache->slab_table_len = 0;
+  cache->slab_table_free_id = NO_SLAB_ID;
+
+  cache->handle_obj_bits = obj_bits;
+  cache->handle_gen_bits = generation_bits;
+
+  return 1;
+}
+
+/* Allocate an object from a cache allocating handles.
+ * If obj is not NULL, it is set to the address of the object.
+ * Return the handle of the object, OBJ_HANDLE_NULL on failure.
+ */
+obj_handle_t objs_cache_alloc_handle(struct Objs_cache *cache, void **obj)
+{
+  obj_handle_t handle = OBJ_HANDLE_NULL;
+
+  if (cache != NULL && cache->slab_table != NULL) {
+    void *allocated_obj = objs_cache_alloc(cache);
+
+    if (allocated_obj != NULL)
+      handle = objs_cache_ptr_to_handle(cache, allocated_obj);
+
+    if (obj != NULL)
+      *obj = allocated_obj;
+  }
+
+  return handle;
+}
+
+void objs_cache_free_handle(struct Objs_cache *cache, obj_handle_t handle)
+{
+  void *obj = objs_cache_handle_to_ptr(cache, handle);
+
+  if (obj == NULL) {
+    printf("Error : invalid or stale handle %u as parameter for %s\n", handle, __func__);
+    return;
+  }
+
+  objs_cache_free(cache, obj);
+}
+
+/* Return the address of the object referenced by handle, NULL if the
+ * handle is invalid or detected as stale.
+ */
+void * objs_cache_handle_to_ptr(const struct Objs_cache *cache, obj_handle_t handle)
+{
+  if (cache == NULL || cache->slab_table == NULL || handle == OBJ_HANDLE_NULL)
+    return NULL;
+
+  unsigned int gen_bits = cache->handle_gen_bits;
+  unsigned int obj_bits = cache->handle_obj_bits;
+
+  unsigned int id = (handle >> (obj_bits + gen_bits)) - 1;
+  unsigned int idx = (handle >> gen_bits) & ((1U << obj_bits) - 1);
+  unsigned int generation = handle & ((1U << gen_bits) - 1);
+
+  if (id >= cache->slab_table_len || idx >= cache->objs_per_slab)
+    return NULL;
+
+  const struct Slab_table_entry *entry = &cache->slab_table[id];
+
+  if (entry->slab == NULL)
+    return NULL;
+
+  if (gen_bits && get_obj_generation(cache, id, idx) != generation)
+    return NULL;
+
+  return get_slab_obj(cache, entry->slab, idx);
+}
+
+/* Return the handle of an allocated object of a cache allocating handles.
+ */
+obj_handle_t objs_cache_ptr_to_handle(const struct Objs_cache *cache, void *obj)
+{
+  if (cache == NULL || cache->slab_table == NULL || obj == NULL)
+    return OBJ_HANDLE_NULL;
+
+  const struct Userland_slab *slab = get_owning_slab(obj, cache->page_size);
+  unsigned int gen_bits = cache->handle_gen_bits;
+  unsigned int idx = get_slab_obj_idx(cache, slab, obj);
+  unsigned int generation = 0;
+
+  if (gen_bits)
+    generation = get_obj_generation(cache, slab->id, idx);
+
+  return ((obj_handle_t)(slab->id + 1) << (cache->handle_obj_bits + gen_bits))
+    | ((obj_handle_t)idx << gen_bits)
+    | generation;
+}
+
 /**********************************************
  *             Debug methods
  *********************************************/
@@ -504,6 +1284,7 @@ void display_cache_info(const struct Objs_cache *cache)
     printf("\ndisplay_cache_info()\n" \
 	   "obj_size : %lu\n" \
 	   "actual_obj_size : %lu\n" \
+	   "align : %lu\n" \
 	   "flags : %u\n" \
 	   "pages_per_slab : %u\n" \
 	   "slab_size : %lu\n" \
@@ -517,6 +1298,7 @@ void display_cache_info(const struct Objs_cache *cache)
 	   "full_slabs_count : %u\n",
 	   cache->obj_size,
 	   cache->actual_obj_size,
+	   cache->align,
 	   cache->flags,
 	   cache->pages_per_slab,
 	   cache->slab_size,
@@ -541,3 +1323,26 @@ void display_slab_info(const struct Userland_slab *slab)
   }
 }
 
+void display_slab_plan(const struct Slab_plan *plan)
+{
+  if (plan != NULL) {
+    printf("\ndisplay_slab_plan()\n" \
+	   "obj_size : %lu\n" \
+	   "align : %lu\n" \
+	   "actual_obj_size : %lu\n" \
+	   "flags : %u\n" \
+	   "pages_per_slab : %u\n" \
+	   "slab_size : %lu\n" \
+	   "objs_per_slab : %u\n" \
+	   "wasted_memory_per_slab : %lu\n",
+	   plan->obj_size,
+	   plan->align,
+	   plan->actual_obj_size,
+	   plan->flags,
+	   plan->pages_per_slab,
+	   plan->slab_size,
+	   plan->objs_per_slab,
+	   plan->wasted_memory_per_slab);
+    printf("\n");
+  }
+}
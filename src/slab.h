@@ -2,10 +2,20 @@
 #define USERLAND_SLAB_H
 
 #include <stdint.h>
+#include <stdatomic.h>
 
 
+//the free objects are linked by 16 bits offsets instead of pointers, slabs are limited to 64 KiB
 #define COMPACT_OBJS 1
 #define SLAB_DESCR_ON_SLAB 2
+//objects are not freed one by one but all at once by objs_cache_reset()
+#define ARENA_OBJS 4
+
+//handle of an object (see objs_cache_enable_handles())
+typedef uint32_t obj_handle_t;
+
+#define OBJ_HANDLE_NULL 0
+#define MAX_HANDLE_GENERATION_BITS 8
 
 #define is_slab_full(slab)			\
   ((slab)->free_objs_count == 0)
@@ -35,14 +45,53 @@ struct Userland_slab{
 
   struct Obj *first_free_obj;
   struct Obj *objs;
+
+  unsigned int id; //index in the slab table of its cache, if any
   
   struct Userland_slab *prev,*next;
 };
 
 
+struct Slab_table_entry{
+  struct Userland_slab *slab; //NULL if the entry is unused
+  //the generation of an object is generation_base + generations[index of the object],
+  //both kept when the slab is destroyed
+  uint8_t *generations; //incremented when the object is freed
+  uint8_t generation_base; //incremented when the slab is reset
+  unsigned int next_free_id;
+};
+
+
+/* Geometry of the slabs of a cache, as chosen by objs_cache_plan() or
+   as used by an existing cache (see objs_cache_get_plan()).
+*/
+struct Slab_plan{
+  size_t obj_size;
+  size_t align;
+  size_t actual_obj_size;
+
+  unsigned int flags;
+
+  unsigned int pages_per_slab;
+  size_t page_size;
+  size_t slab_size;
+
+  size_t first_page_offset; //offset of the first object of the first page
+  size_t page_offset;       //offset of the first object of the other pages
+
+  unsigned int objs_first_page;
+  unsigned int objs_per_page;
+  unsigned int objs_per_slab;
+
+  //bytes of a slab (and of its off-slab descriptor) not holding object data
+  size_t wasted_memory_per_slab;
+};
+
+
 struct Objs_cache{
   size_t obj_size;
   size_t actual_obj_size;  //size of the object + size of its header
+  size_t align;
 
   unsigned int flags;
 
@@ -56,6 +105,10 @@ struct Objs_cache{
   size_t page_size;
   size_t slab_size;
 
+  size_t first_page_offset;
+  size_t page_offset;
+
+  unsigned int objs_first_page;
   unsigned int objs_per_page;
   unsigned int objs_per_slab;
 
@@ -69,11 +122,22 @@ struct Objs_cache{
   unsigned int free_slabs_count, partial_slabs_count, full_slabs_count;
   
   struct Userland_slab *free_slabs, *partial_slabs, *full_slabs;
+
+  //table of the slabs, only used by caches allocating handles
+  struct Slab_table_entry *slab_table;
+  unsigned int slab_table_size, slab_table_len;
+  unsigned int slab_table_free_id;
+
+  unsigned int handle_obj_bits, handle_gen_bits;
+
+  //see objs_cache_lock()
+  atomic_flag lock;
 };
 
 
 int slab_allocator_init(void);
 void slab_allocator_destroy(void);
+void slab_allocator_configure_pool(unsigned int max_pooled_slabs, int advise_free);
 
 struct Objs_cache * objs_cache_init(struct Objs_cache *cache,
 				    size_t obj_size,
@@ -84,12 +148,31 @@ struct Objs_cache * _objs_cache_init(struct Objs_cache *cache,
 				     unsigned int flags,
 				     void (*ctor)(void *),
 				     void (*slab_freeing_policy)(struct Objs_cache*));
+struct Slab_plan * objs_cache_plan(struct Slab_plan *plan,
+				   size_t obj_size,
+				   size_t align,
+				   size_t max_slab_size);
+struct Objs_cache * objs_cache_init_with_plan(struct Objs_cache *cache,
+					      const struct Slab_plan *plan,
+					      void (*ctor)(void *),
+					      void (*slab_freeing_policy)(struct Objs_cache*));
+void objs_cache_get_plan(const struct Objs_cache *cache, struct Slab_plan *plan);
 void objs_cache_destroy(struct Objs_cache *cache);
 void * objs_cache_alloc(struct Objs_cache *cache);
 void objs_cache_free(struct Objs_cache *cache, void *obj);
+void objs_cache_reset(struct Objs_cache *cache);
+void objs_cache_lock(struct Objs_cache *cache);
+void objs_cache_unlock(struct Objs_cache *cache);
+
+int objs_cache_enable_handles(struct Objs_cache *cache, unsigned int generation_bits);
+obj_handle_t objs_cache_alloc_handle(struct Objs_cache *cache, void **obj);
+void objs_cache_free_handle(struct Objs_cache *cache, obj_handle_t handle);
+void * objs_cache_handle_to_ptr(const struct Objs_cache *cache, obj_handle_t handle);
+obj_handle_t objs_cache_ptr_to_handle(const struct Objs_cache *cache, void *obj);
 
 
 void display_cache_info(const struct Objs_cache *cache);
 void display_slab_info(const struct Userland_slab *slab);
+void display_slab_plan(const struct Slab_plan *plan);
 
 #endif